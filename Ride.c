@@ -1,11 +1,24 @@
+#define _DEFAULT_SOURCE  // POSIX and BSD extensions under -std=c11
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define MAX_DRIVERS 200
 #define MAX_RIDERS  200
 #define MAX_RIDES   500
+#define CACHE_LINE  64
 
 /* -----------------------------
    Models
@@ -15,21 +28,24 @@ typedef struct {
     char name[32];
     float x, y;       // location
     float rating;     // 0.0 - 5.0
-    int available;    // 1 = available, 0 = busy
+    atomic_int available; // 1 = available, 0 = busy (claimed via CAS when concurrent)
 } Driver;
 
 typedef struct {
     int id;
     char name[32];
     float x, y;       // pickup location
+    float destX, destY; // drop-off location
+    double requestTime; // seconds; sim clock in event-driven mode
 } Rider;
 
 typedef struct {
     int rideId;
     int riderId;
     int driverId;
-    float distance;
+    float distance;   // trip length, pickup -> drop-off (km)
     float fare;
+    long long time;   // unix seconds when the ride was recorded
 } Ride;
 
 /* -----------------------------
@@ -43,7 +59,7 @@ int rideCount = 0;
 
 int nextRiderId = 1;
 int nextDriverId = 1;
-int nextRideId = 1;
+atomic_int nextRideId = 1;
 
 /* -----------------------------
    Rider Queue (circular)
@@ -93,7 +109,7 @@ typedef struct {
 } DriverPQItem;
 
 typedef struct {
-    DriverPQItem heap[MAX_DRIVERS];
+    DriverPQItem heap[MAX_DRIVERS + 1]; // 1-indexed: heap[1..MAX_DRIVERS]
     int size;
 } DriverPQ;
 
@@ -158,6 +174,237 @@ void pause_enter() {
     getchar();
 }
 
+/* -----------------------------
+   Metrics: counters + log-linear (HDR-style) histograms
+   A value lands in one of 16 sub-buckets of its power of two, so
+   every bucket is within ~6% of the true value. Each metric is split
+   into per-thread shards of relaxed atomics so dispatch workers don't
+   fight over cache lines; readers sum the shards on demand.
+--------------------------------*/
+#define HIST_SUB_BITS  4
+#define HIST_SUB       (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS   ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+#define METRIC_SHARDS  8
+
+// No per-shard count: it is the sum of the buckets, so recording
+// costs two atomic adds plus a max check instead of three adds.
+typedef struct {
+    atomic_ullong sum;
+    atomic_ullong max;
+    atomic_ullong buckets[HIST_BUCKETS];
+} HistShard;
+
+typedef struct {
+    const char *name;
+    const char *help;
+    HistShard shard[METRIC_SHARDS];
+} Histogram;
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_ullong v;
+} CounterCell;
+
+typedef struct {
+    const char *name;
+    const char *help;
+    CounterCell cell[METRIC_SHARDS];
+} Counter;
+
+Counter mRequests      = { .name = "ride_requests_total", .help = "Rider requests received" };
+Counter mRejected      = { .name = "ride_requests_rejected_total", .help = "Rider requests dropped because the queue was full" };
+Counter mDispatches    = { .name = "ride_dispatches_total", .help = "Riders matched to a driver" };
+Counter mNoDriver      = { .name = "ride_dispatch_no_driver_total", .help = "Riders who found no available driver when matched (once per rider)" };
+Counter mConflicts     = { .name = "ride_claim_conflicts_total", .help = "Driver claims lost to another worker" };
+Counter mCrossRegion   = { .name = "ride_cross_region_dispatches_total", .help = "Matches that borrowed a driver from another region" };
+
+Histogram hQueueWait   = { .name = "ride_queue_wait_us", .help = "Time from request to dispatch (wall clock)" };
+Histogram hMatchLat    = { .name = "ride_match_latency_ns", .help = "Time spent choosing and claiming a driver, successful attempt only" };
+Histogram hCandidates  = { .name = "ride_match_candidates", .help = "Available drivers examined per dispatch" };
+Histogram hPickupDist  = { .name = "ride_pickup_distance_meters", .help = "Driver-to-rider distance at match" };
+Histogram hFare        = { .name = "ride_fare_paise", .help = "Fare per billed ride" };
+
+Counter   *allCounters[]   = { &mRequests, &mRejected, &mDispatches, &mNoDriver, &mConflicts, &mCrossRegion };
+Histogram *allHistograms[] = { &hQueueWait, &hMatchLat, &hCandidates, &hPickupDist, &hFare };
+
+atomic_int nextMetricShard;
+_Thread_local int metricShard = -1;
+
+int metric_shard() {
+    if (metricShard < 0)
+        metricShard = atomic_fetch_add_explicit(&nextMetricShard, 1, memory_order_relaxed) % METRIC_SHARDS;
+    return metricShard;
+}
+
+int hist_bucket(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) - HIST_SUB);
+}
+
+// Largest value that maps to bucket b.
+uint64_t hist_bucket_high(int b) {
+    if (b < HIST_SUB) return (uint64_t)b;
+    int shift = b / HIST_SUB - 1;
+    uint64_t low = (uint64_t)(HIST_SUB + b % HIST_SUB) << shift;
+    return low + (((uint64_t)1 << shift) - 1);
+}
+
+void shard_record(HistShard *s, uint64_t v) {
+    atomic_fetch_add_explicit(&s->sum, v, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->buckets[hist_bucket(v)], 1, memory_order_relaxed);
+    uint64_t m = atomic_load_explicit(&s->max, memory_order_relaxed);
+    while (v > m && !atomic_compare_exchange_weak_explicit(&s->max, &m, v,
+                        memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+typedef struct {
+    uint64_t count, sum, max;
+    uint64_t buckets[HIST_BUCKETS];
+} HistSnapshot;
+
+// Add one shard into a plain snapshot; callers zero the snapshot first.
+void shard_accumulate(HistShard *s, HistSnapshot *out) {
+    out->sum += atomic_load_explicit(&s->sum, memory_order_relaxed);
+    uint64_t m = atomic_load_explicit(&s->max, memory_order_relaxed);
+    if (m > out->max) out->max = m;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        uint64_t c = atomic_load_explicit(&s->buckets[b], memory_order_relaxed);
+        out->buckets[b] += c;
+        out->count += c;
+    }
+}
+
+uint64_t snapshot_quantile(const HistSnapshot *s, double q) {
+    if (s->count == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(q * s->count), seen = 0;
+    if (rank == 0) rank = 1;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += s->buckets[b];
+        if (seen >= rank) {
+            uint64_t hi = hist_bucket_high(b);
+            return hi < s->max ? hi : s->max;
+        }
+    }
+    return s->max;
+}
+
+void hist_record(Histogram *h, uint64_t v) { shard_record(&h->shard[metric_shard()], v); }
+
+// Sum all shards (no cross-shard ordering guarantees, fine for reporting).
+void hist_snapshot(Histogram *h, HistSnapshot *out) {
+    memset(out, 0, sizeof *out);
+    for (int k = 0; k < METRIC_SHARDS; k++) shard_accumulate(&h->shard[k], out);
+}
+
+void counter_add(Counter *c, uint64_t n) {
+    atomic_fetch_add_explicit(&c->cell[metric_shard()].v, n, memory_order_relaxed);
+}
+
+uint64_t counter_value(Counter *c) {
+    uint64_t total = 0;
+    for (int k = 0; k < METRIC_SHARDS; k++)
+        total += atomic_load_explicit(&c->cell[k].v, memory_order_relaxed);
+    return total;
+}
+
+uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+double now_seconds() { return now_ns() * 1e-9; }
+
+// One call per successful match, timed from startNs to endNs.
+void metrics_record_match(uint64_t startNs, uint64_t endNs, int candidates, float pickupKm) {
+    counter_add(&mDispatches, 1);
+    hist_record(&hMatchLat, endNs - startNs);
+    hist_record(&hCandidates, (uint64_t)candidates);
+    hist_record(&hPickupDist, (uint64_t)(pickupKm * 1000.0f + 0.5f));
+}
+
+// Call where the fare is billed (at match live, at drop-off in the sim).
+void metrics_record_fare(float fare) {
+    hist_record(&hFare, (uint64_t)(fare * 100.0f + 0.5f));
+}
+
+void metrics_record_queue_wait(double requestTime, uint64_t nowNs) {
+    double waited = nowNs * 1e-9 - requestTime;
+    hist_record(&hQueueWait, waited > 0 ? (uint64_t)(waited * 1e6) : 0);
+}
+
+/* -----------------------------
+   Metrics export (JSON or Prometheus text exposition)
+--------------------------------*/
+enum { METRICS_JSON = 1, METRICS_PROMETHEUS = 2 };
+
+const double metricQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+const char  *quantileKeys[]    = { "p50", "p90", "p99", "p999" };
+#define NUM_QUANTILES 4
+#define NUM_COUNTERS   ((int)(sizeof allCounters / sizeof allCounters[0]))
+#define NUM_HISTOGRAMS ((int)(sizeof allHistograms / sizeof allHistograms[0]))
+
+void metrics_dump(FILE *fp, int format) {
+    HistSnapshot snap;
+    if (format == METRICS_JSON) {
+        fprintf(fp, "{\n  \"counters\": {\n");
+        for (int i = 0; i < NUM_COUNTERS; i++)
+            fprintf(fp, "    \"%s\": %llu%s\n", allCounters[i]->name,
+                    (unsigned long long)counter_value(allCounters[i]), i + 1 < NUM_COUNTERS ? "," : "");
+        fprintf(fp, "  },\n  \"histograms\": {\n");
+        for (int i = 0; i < NUM_HISTOGRAMS; i++) {
+            hist_snapshot(allHistograms[i], &snap);
+            unsigned long long n = snap.count, sum = snap.sum;
+            fprintf(fp, "    \"%s\": {\"count\": %llu, \"sum\": %llu, \"mean\": %.2f, \"max\": %llu",
+                    allHistograms[i]->name, n, sum, n ? (double)sum / n : 0.0,
+                    (unsigned long long)snap.max);
+            for (int k = 0; k < NUM_QUANTILES; k++)
+                fprintf(fp, ", \"%s\": %llu", quantileKeys[k],
+                        (unsigned long long)snapshot_quantile(&snap, metricQuantiles[k]));
+            fprintf(fp, "}%s\n", i + 1 < NUM_HISTOGRAMS ? "," : "");
+        }
+        fprintf(fp, "  }\n}\n");
+    } else {
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            fprintf(fp, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                    allCounters[i]->name, allCounters[i]->help, allCounters[i]->name,
+                    allCounters[i]->name, (unsigned long long)counter_value(allCounters[i]));
+        }
+        for (int i = 0; i < NUM_HISTOGRAMS; i++) {
+            const char *name = allHistograms[i]->name;
+            hist_snapshot(allHistograms[i], &snap);
+            fprintf(fp, "# HELP %s %s\n# TYPE %s summary\n", name, allHistograms[i]->help, name);
+            for (int k = 0; k < NUM_QUANTILES; k++)
+                fprintf(fp, "%s{quantile=\"%g\"} %llu\n", name, metricQuantiles[k],
+                        (unsigned long long)snapshot_quantile(&snap, metricQuantiles[k]));
+            fprintf(fp, "%s_sum %llu\n%s_count %llu\n", name, (unsigned long long)snap.sum,
+                    name, (unsigned long long)snap.count);
+        }
+    }
+    fflush(fp);
+}
+
+// RIDE_METRICS=json|prometheus dumps at exit, to RIDE_METRICS_FILE or stdout.
+int exitMetricsFormat = 0;
+
+void metrics_dump_at_exit() {
+    const char *path = getenv("RIDE_METRICS_FILE");
+    FILE *fp = path ? fopen(path, "w") : stdout;
+    if (!fp) { fprintf(stderr, "Failed to open %s for metrics.\n", path); return; }
+    metrics_dump(fp, exitMetricsFormat);
+    if (fp != stdout) fclose(fp);
+}
+
+void metrics_init_from_env() {
+    const char *fmt = getenv("RIDE_METRICS");
+    if (!fmt) return;
+    if (strcmp(fmt, "json") == 0) exitMetricsFormat = METRICS_JSON;
+    else if (strcmp(fmt, "prometheus") == 0 || strcmp(fmt, "prom") == 0) exitMetricsFormat = METRICS_PROMETHEUS;
+    else { fprintf(stderr, "Unknown RIDE_METRICS format '%s' (use json or prometheus).\n", fmt); return; }
+    atexit(metrics_dump_at_exit);
+}
+
 /* -----------------------------
    Core: Build driver PQ for a rider
 --------------------------------*/
@@ -175,12 +422,428 @@ void build_driver_pq_for_rider(const Rider *r, DriverPQ *pq) {
 }
 
 /* -----------------------------
-   Ride history helpers
+   Ride history (columnar binary file)
+   rides[] is the in-memory write batch. When it fills up, before
+   analytics and at exit it is appended to the history file as one
+   block: a 16-byte header followed by one contiguous array per
+   column. Loading mmaps the file and points straight into them.
+--------------------------------*/
+#define HISTORY_FILE  "rides.bin"
+#define HISTORY_MAGIC 0x31434852u  // "RHC1" on little-endian
+
+typedef struct {
+    uint32_t magic;
+    uint32_t rows;
+    uint64_t bytes;    // whole block: header + columns + padding to 8
+} HistoryBlockHeader;
+
+// Column order inside a block; timestamps go first to stay 8-aligned.
+typedef struct {
+    uint32_t rows;
+    const int64_t *time;
+    const int32_t *rideId;
+    const int32_t *riderId;
+    const int32_t *driverId;
+    const float   *distance;
+    const float   *fare;
+} HistoryBlock;
+
+typedef struct {
+    void *base;
+    size_t length;
+    HistoryBlock *blocks;
+    int blockCount;
+    long rows;
+    int truncated;     // trailing bytes that don't form a valid block
+} HistoryView;
+
+const char *historyPath = NULL;          // NULL: keep history in memory only
+int historyAppendBlocked = 0;            // file didn't parse cleanly; never append to it
+pthread_mutex_t historyLock = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t history_block_bytes(uint32_t rows) {
+    uint64_t b = sizeof(HistoryBlockHeader)
+               + (uint64_t)rows * (sizeof(int64_t) + 3 * sizeof(int32_t) + 2 * sizeof(float));
+    return (b + 7) & ~(uint64_t)7;
+}
+
+int write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return 0;
+        p += w;
+        len -= (size_t)w;
+    }
+    return 1;
+}
+
+// Caller holds historyLock. The block is built in memory and written
+// under an exclusive flock, so other processes can't interleave with
+// it; on any failure the file is cut back to its old size and rides[]
+// is kept for the next attempt.
+void history_flush_locked() {
+    if (rideCount == 0 || !historyPath || historyAppendBlocked) return;
+
+    uint32_t n = (uint32_t)rideCount;
+    HistoryBlockHeader h = { HISTORY_MAGIC, n, history_block_bytes(n) };
+    char *block = calloc(1, h.bytes);
+    if (!block) { printf("Out of memory while saving ride history.\n"); return; }
+    memcpy(block, &h, sizeof h);
+    int64_t *tCol      = (int64_t *)(block + sizeof h);
+    int32_t *rideCol   = (int32_t *)(tCol + n);
+    int32_t *riderCol  = rideCol + n;
+    int32_t *driverCol = riderCol + n;
+    float   *distCol   = (float *)(driverCol + n);
+    float   *fareCol   = distCol + n;
+    for (uint32_t i = 0; i < n; i++) {
+        tCol[i]      = rides[i].time;
+        rideCol[i]   = rides[i].rideId;
+        riderCol[i]  = rides[i].riderId;
+        driverCol[i] = rides[i].driverId;
+        distCol[i]   = rides[i].distance;
+        fareCol[i]   = rides[i].fare;
+    }
+
+    int fd = open(historyPath, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) { printf("Failed to open %s for appending.\n", historyPath); free(block); return; }
+    int ok = 0;
+    struct stat st;
+    if (flock(fd, LOCK_EX) == 0 && fstat(fd, &st) == 0) {
+        ok = write_all(fd, block, h.bytes);
+        if (!ok && ftruncate(fd, st.st_size) != 0)
+            printf("Could not roll back a partial block in %s.\n", historyPath);
+    }
+    if (close(fd) != 0) ok = 0;   // also drops the flock
+    free(block);
+    if (!ok) {
+        // Every full batch retries; only say so once.
+        static int warned = 0;
+        if (!warned) printf("Failed to append ride history to %s.\n", historyPath);
+        warned = 1;
+        return;
+    }
+    rideCount = 0;
+}
+
+void history_flush() {
+    pthread_mutex_lock(&historyLock);
+    history_flush_locked();
+    pthread_mutex_unlock(&historyLock);
+}
+
+// Caller holds historyLock. Drops the ride only if the batch is full
+// and can't be flushed (persistence off, appends blocked or write error).
+void history_append_locked(const Ride *r) {
+    if (rideCount >= MAX_RIDES) history_flush_locked();
+    if (rideCount < MAX_RIDES) rides[rideCount++] = *r;
+}
+
+void record_ride(int riderId, int driverId, float distance, float fare, long long time) {
+    Ride r = { .rideId = nextRideId++, .riderId = riderId, .driverId = driverId,
+               .distance = distance, .fare = fare, .time = time };
+    pthread_mutex_lock(&historyLock);
+    history_append_locked(&r);
+    pthread_mutex_unlock(&historyLock);
+}
+
+// Synthetic runs (stress test, simulation) keep their rides in memory
+// unless RIDE_HISTORY names the file explicitly, so menu options can't
+// fill rides.bin with made-up trips. Real rides still pending are
+// flushed first and survive the run.
+typedef struct {
+    const char *path;
+    int keep;          // rides[] entries that predate the run
+} SyntheticHistory;
+
+SyntheticHistory history_begin_synthetic() {
+    pthread_mutex_lock(&historyLock);
+    history_flush_locked();
+    SyntheticHistory sh = { historyPath, rideCount };
+    if (!getenv("RIDE_HISTORY")) historyPath = NULL;
+    pthread_mutex_unlock(&historyLock);
+    return sh;
+}
+
+void history_end_synthetic(SyntheticHistory sh) {
+    pthread_mutex_lock(&historyLock);
+    if (historyPath != sh.path) rideCount = sh.keep;   // drop the synthetic rides
+    historyPath = sh.path;
+    pthread_mutex_unlock(&historyLock);
+}
+
+void history_unmap(HistoryView *v);
+
+// Returns 0 on I/O or allocation error. A missing file is just an
+// empty history.
+int history_map(HistoryView *v) {
+    memset(v, 0, sizeof *v);
+    if (!historyPath) return 1;
+    int fd = open(historyPath, O_RDONLY);
+    if (fd < 0) return errno == ENOENT;
+    // Shared lock: the size we map never includes a block mid-append.
+    struct stat st;
+    if (flock(fd, LOCK_SH) != 0 || fstat(fd, &st) != 0) { close(fd); return 0; }
+    if (st.st_size == 0) { close(fd); return 1; }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 0;
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+    v->base = base;
+    v->length = (size_t)st.st_size;
+
+    int cap = 0;
+    size_t off = 0;
+    while (v->length - off >= sizeof(HistoryBlockHeader)) {
+        const HistoryBlockHeader *h = (const HistoryBlockHeader *)((const char *)base + off);
+        if (h->magic != HISTORY_MAGIC || h->bytes != history_block_bytes(h->rows)
+            || h->bytes > v->length - off) break;
+        if (v->blockCount == cap) {
+            cap = cap ? cap * 2 : 64;
+            HistoryBlock *grown = realloc(v->blocks, cap * sizeof *grown);
+            if (!grown) { history_unmap(v); return 0; }
+            v->blocks = grown;
+        }
+        const char *p = (const char *)(h + 1);
+        HistoryBlock *b = &v->blocks[v->blockCount++];
+        b->rows     = h->rows;
+        b->time     = (const int64_t *)p; p += h->rows * sizeof(int64_t);
+        b->rideId   = (const int32_t *)p; p += h->rows * sizeof(int32_t);
+        b->riderId  = (const int32_t *)p; p += h->rows * sizeof(int32_t);
+        b->driverId = (const int32_t *)p; p += h->rows * sizeof(int32_t);
+        b->distance = (const float *)p;   p += h->rows * sizeof(float);
+        b->fare     = (const float *)p;
+        v->rows += h->rows;
+        off += h->bytes;
+    }
+    v->truncated = off != v->length;
+    return 1;
+}
+
+void history_unmap(HistoryView *v) {
+    if (v->base) munmap(v->base, v->length);
+    free(v->blocks);
+    memset(v, 0, sizeof *v);
+}
+
+/* -----------------------------
+   Column scans
+   Plain loops over contiguous arrays. Reductions keep eight
+   independent lanes so the compiler can vectorize them without
+   -ffast-math reassociation.
 --------------------------------*/
-void record_ride(int riderId, int driverId, float distance, float fare) {
-    if (rideCount >= MAX_RIDES) return;
-    rides[rideCount++] = (Ride){ .rideId = nextRideId++, .riderId = riderId,
-                                 .driverId = driverId, .distance = distance, .fare = fare };
+double column_sum_f32(const float *x, uint32_t n) {
+    double lane[8] = {0};
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        for (int k = 0; k < 8; k++) lane[k] += x[i + k];
+    double s = 0.0;
+    for (int k = 0; k < 8; k++) s += lane[k];
+    for (; i < n; i++) s += x[i];
+    return s;
+}
+
+int32_t column_max_i32(const int32_t *x, uint32_t n, int32_t m) {
+    for (uint32_t i = 0; i < n; i++) m = x[i] > m ? x[i] : m;
+    return m;
+}
+
+void column_range_i64(const int64_t *x, uint32_t n, int64_t *lo, int64_t *hi) {
+    int64_t a = *lo, b = *hi;
+    for (uint32_t i = 0; i < n; i++) {
+        a = x[i] < a ? x[i] : a;
+        b = x[i] > b ? x[i] : b;
+    }
+    *lo = a; *hi = b;
+}
+
+// defaultPath is the file for this mode (NULL: memory only); RIDE_HISTORY
+// overrides it ("" keeps history in memory only). Continues ride ids
+// from the file. A file that can't be read or has
+// bytes that aren't valid blocks is never modified: appends are
+// switched off for the session and new rides stay in memory.
+void history_init(const char *defaultPath) {
+    const char *path = getenv("RIDE_HISTORY");
+    historyPath = path ? (*path ? path : NULL) : defaultPath;
+    HistoryView v;
+    if (!history_map(&v)) {
+        historyAppendBlocked = 1;
+        printf("Warning: could not read %s; new rides will not be saved to it.\n", historyPath);
+    } else {
+        int32_t maxId = 0;
+        for (int k = 0; k < v.blockCount; k++)
+            maxId = column_max_i32(v.blocks[k].rideId, v.blocks[k].rows, maxId);
+        if (maxId >= nextRideId) nextRideId = maxId + 1;
+        if (v.truncated) {
+            historyAppendBlocked = 1;
+            printf("Warning: %s is not a clean ride history; new rides will not be saved to it.\n",
+                   historyPath);
+        }
+        history_unmap(&v);
+    }
+    atexit(history_flush);
+}
+
+/* -----------------------------
+   Analytics over the mapped history
+--------------------------------*/
+typedef struct {
+    int driverId;
+    long trips;
+    double revenue;
+    double km;
+} DriverRevenue;
+
+int revenue_desc(const void *a, const void *b) {
+    double ra = ((const DriverRevenue *)a)->revenue, rb = ((const DriverRevenue *)b)->revenue;
+    return (ra < rb) - (ra > rb);
+}
+
+void analytics_revenue_per_driver(const HistoryView *v, int top) {
+    int32_t maxId = 0;
+    for (int k = 0; k < v->blockCount; k++)
+        maxId = column_max_i32(v->blocks[k].driverId, v->blocks[k].rows, maxId);
+    DriverRevenue *per = calloc((size_t)maxId + 1, sizeof *per);
+    if (!per) { printf("Out of memory.\n"); return; }
+    for (int k = 0; k < v->blockCount; k++) {
+        const HistoryBlock *b = &v->blocks[k];
+        for (uint32_t i = 0; i < b->rows; i++) {
+            DriverRevenue *d = &per[b->driverId[i] < 0 ? 0 : b->driverId[i]];
+            d->trips++;
+            d->revenue += b->fare[i];
+            d->km += b->distance[i];
+        }
+    }
+    int n = 0;
+    for (int id = 0; id <= maxId; id++)
+        if (per[id].trips) { per[n] = per[id]; per[n].driverId = id; n++; }
+    qsort(per, n, sizeof *per, revenue_desc);
+
+    printf("\n-- Revenue per Driver (top %d of %d) --\n", n < top ? n : top, n);
+    printf("DriverID  Trips      Distance(km)    Revenue          Avg Fare\n");
+    for (int i = 0; i < n && i < top; i++)
+        printf("%-9d %-10ld %12.1f    ₹%-14.2f ₹%.2f\n", per[i].driverId, per[i].trips,
+               per[i].km, per[i].revenue, per[i].revenue / per[i].trips);
+    free(per);
+}
+
+#define DIST_BINS 30
+
+void analytics_distance_distribution(const HistoryView *v, float binKm) {
+    long bins[DIST_BINS + 1] = {0};   // last bin: everything beyond
+    long invalid = 0;                 // negative, NaN or infinite distances
+    double totalKm = 0.0;
+    float maxKm = 0.0f;
+    for (int k = 0; k < v->blockCount; k++) {
+        const HistoryBlock *b = &v->blocks[k];
+        long blockInvalid = 0;
+        double validKm = 0.0;
+        for (uint32_t i = 0; i < b->rows; i++) {
+            float d = b->distance[i];
+            if (!isfinite(d) || d < 0.0f) { blockInvalid++; continue; }
+            float q = d / binKm;      // compare before casting: huge d overflows int
+            bins[q < DIST_BINS ? (int)q : DIST_BINS]++;
+            validKm += d;
+            maxKm = d > maxKm ? d : maxKm;
+        }
+        // Clean blocks take the vectorized sum; bad rows would poison it.
+        totalKm += blockInvalid ? validKm : column_sum_f32(b->distance, b->rows);
+        invalid += blockInvalid;
+    }
+    long valid = v->rows - invalid;
+    long peak = 1;
+    for (int i = 0; i <= DIST_BINS; i++) if (bins[i] > peak) peak = bins[i];
+
+    printf("\n-- Distance Distribution (%.1f km bins) --\n", binKm);
+    printf("Rides: %ld  Mean: %.2f km  Max: %.2f km\n",
+           valid, valid ? totalKm / valid : 0.0, maxKm);
+    if (invalid) printf("Skipped %ld rides with an invalid distance.\n", invalid);
+    for (int i = 0; i <= DIST_BINS; i++) {
+        if (!bins[i]) continue;
+        if (i < DIST_BINS) printf("%6.1f-%-6.1f ", i * binKm, (i + 1) * binKm);
+        else               printf("%6.1f+      ", DIST_BINS * binKm);
+        printf("%9ld  ", bins[i]);
+        int stars = (int)(40 * bins[i] / peak);
+        for (int s = 0; s < stars; s++) printf("*");
+        printf("\n");
+    }
+}
+
+#define MAX_WINDOWS      100000
+#define PRINTED_WINDOWS  48
+
+void analytics_fare_by_window(const HistoryView *v, long long windowSec) {
+    if (v->rows == 0 || windowSec <= 0) return;
+    int64_t lo = INT64_MAX, hi = INT64_MIN;
+    for (int k = 0; k < v->blockCount; k++)
+        column_range_i64(v->blocks[k].time, v->blocks[k].rows, &lo, &hi);
+    // Align window edges to local wall-clock time, since that is what
+    // the labels show (e.g. IST is UTC+5:30, so UTC edges read :30).
+    time_t first = (time_t)lo;
+    struct tm local;
+    long long gmtoff = localtime_r(&first, &local) ? local.tm_gmtoff : 0;
+    lo -= ((lo + gmtoff) % windowSec + windowSec) % windowSec;
+    long long windows = (hi - lo) / windowSec + 1;
+    if (windows > MAX_WINDOWS) {
+        printf("History spans %lld windows of %lld s; pick a larger window.\n", windows, windowSec);
+        return;
+    }
+    double *fare = calloc((size_t)windows, sizeof *fare);
+    long *count = calloc((size_t)windows, sizeof *count);
+    if (!fare || !count) { free(fare); free(count); printf("Out of memory.\n"); return; }
+    for (int k = 0; k < v->blockCount; k++) {
+        const HistoryBlock *b = &v->blocks[k];
+        for (uint32_t i = 0; i < b->rows; i++) {
+            long long w = (b->time[i] - lo) / windowSec;
+            fare[w] += b->fare[i];
+            count[w]++;
+        }
+    }
+
+    printf("\n-- Fare Totals per %lld min Window --\n", windowSec / 60);
+    printf("Window start        Rides      Fare\n");
+    int printed = 0;
+    long skipped = 0;
+    for (long long w = 0; w < windows; w++) {
+        if (!count[w]) continue;
+        if (printed == PRINTED_WINDOWS) { skipped++; continue; }
+        time_t start = (time_t)(lo + w * windowSec);
+        char label[32];
+        strftime(label, sizeof label, "%Y-%m-%d %H:%M", localtime(&start));
+        printf("%-19s %-10ld ₹%.2f\n", label, count[w], fare[w]);
+        printed++;
+    }
+    if (skipped) printf("... %ld more non-empty window(s)\n", skipped);
+    free(fare);
+    free(count);
+}
+
+// Flush pending rides and map the file; prints why if it can't.
+int history_open_for_read(HistoryView *v) {
+    if (!historyPath) {
+        printf("History persistence is off (RIDE_HISTORY is empty).\n");
+        return 0;
+    }
+    history_flush();
+    if (!history_map(v)) { printf("Failed to read %s.\n", historyPath); return 0; }
+    if (v->truncated) printf("Warning: ignoring a damaged tail of %s.\n", historyPath);
+    return 1;
+}
+
+void run_history_analytics(int report, long long windowSec) {
+    HistoryView v;
+    if (!history_open_for_read(&v)) return;
+    if (v.rows == 0) { printf("No rides in history.\n"); history_unmap(&v); return; }
+    double total = 0.0;
+    for (int k = 0; k < v.blockCount; k++)
+        total += column_sum_f32(v.blocks[k].fare, v.blocks[k].rows);
+    printf("\nHistory: %ld rides in %d block(s), fare total ₹%.2f\n", v.rows, v.blockCount, total);
+
+    if (report == 0 || report == 1) analytics_revenue_per_driver(&v, 20);
+    if (report == 0 || report == 2) analytics_distance_distribution(&v, 1.0f);
+    if (report == 0 || report == 3) analytics_fare_by_window(&v, windowSec);
+    history_unmap(&v);
 }
 
 /* -----------------------------
@@ -219,16 +882,24 @@ void action_list_drivers() {
 }
 
 void action_add_rider() {
-    if (rq_full(&riderQueue)) { printf("Rider queue full.\n"); return; }
+    if (rq_full(&riderQueue)) {
+        counter_add(&mRejected, 1);
+        printf("Rider queue full.\n");
+        return;
+    }
     Rider r;
     r.id = nextRiderId++;
     printf("Rider name: "); scanf("%31s", r.name);
     printf("Pickup location x y: "); scanf("%f %f", &r.x, &r.y);
+    printf("Drop-off location x y: "); scanf("%f %f", &r.destX, &r.destY);
+    r.requestTime = now_seconds();
+    counter_add(&mRequests, 1);
     if (!rq_enqueue(&riderQueue, r)) {
         printf("Failed to enqueue rider.\n");
         return;
     }
-    printf("Added Rider #%d (%s) pickup at (%.2f, %.2f)\n", r.id, r.name, r.x, r.y);
+    printf("Added Rider #%d (%s) pickup at (%.2f, %.2f), drop-off at (%.2f, %.2f)\n",
+           r.id, r.name, r.x, r.y, r.destX, r.destY);
 }
 
 void action_show_rider_queue() {
@@ -237,7 +908,8 @@ void action_show_rider_queue() {
     int idx = riderQueue.head;
     for (int k = 0; k < riderQueue.size; k++) {
         Rider *r = &riderQueue.buf[idx];
-        printf("Rider %-3d %-15s (%6.2f,%6.2f)\n", r->id, r->name, r->x, r->y);
+        printf("Rider %-3d %-15s (%6.2f,%6.2f) -> (%6.2f,%6.2f)\n",
+               r->id, r->name, r->x, r->y, r->destX, r->destY);
         idx = (idx + 1) % MAX_RIDERS;
     }
 }
@@ -259,10 +931,14 @@ int dispatch_one() {
     rq_front(&riderQueue, &rfront);
 
     // Build PQ of available drivers for this rider
+    uint64_t matchStart = now_ns();
     DriverPQ pq;
     build_driver_pq_for_rider(&rfront, &pq);
+    int candidates = pq.size;
 
+    static int missedRiderId = 0;   // front rider already counted as a miss
     if (pq_empty(&pq)) {
+        if (rfront.id != missedRiderId) { counter_add(&mNoDriver, 1); missedRiderId = rfront.id; }
         printf("No available drivers for Rider #%d (%s) right now. Try later.\n",
                rfront.id, rfront.name);
         return 0; // rider stays in queue
@@ -281,14 +957,20 @@ int dispatch_one() {
     d->available = 0;
     d->x = r.x; d->y = r.y;
 
-    float km = best.distance; // treat units as km for demo
+    // Bill the trip itself (pickup -> drop-off), same as the simulator
+    float pickupKm = best.distance; // treat units as km for demo
+    float km = dist(r.x, r.y, r.destX, r.destY);
     float fare = estimate_fare(km);
 
-    record_ride(r.id, d->id, km, fare);
+    uint64_t matchEnd = now_ns();
+    metrics_record_match(matchStart, matchEnd, candidates, pickupKm);
+    metrics_record_fare(fare);
+    metrics_record_queue_wait(r.requestTime, matchEnd);
+    record_ride(r.id, d->id, km, fare, (long long)time(NULL));
 
     printf("Assigned Driver #%d (%s, %.1f★) to Rider #%d (%s). "
-           "Distance: %.2f km, Fare: ₹%.2f\n",
-           d->id, d->name, d->rating, r.id, r.name, km, fare);
+           "Pickup: %.2f km, Trip: %.2f km, Fare: ₹%.2f\n",
+           d->id, d->name, d->rating, r.id, r.name, pickupKm, km, fare);
 
     return 1;
 }
@@ -302,15 +984,33 @@ void action_dispatch_all() {
     else printf("Dispatched %d ride(s).\n", count);
 }
 
+#define SHOWN_RIDES 50
+
 void action_show_ride_history() {
-    if (rideCount == 0) { printf("No rides yet.\n"); return; }
-    printf("\n-- Ride History --\n");
+    HistoryView v;
+    history_flush();
+    if (!history_map(&v)) { printf("Failed to read %s.\n", historyPath); return; }
+    long total = v.rows + rideCount;
+    if (total == 0) { printf("No rides yet.\n"); history_unmap(&v); return; }
+
+    // Most recent rides only; the file can hold millions.
+    long skip = total > SHOWN_RIDES ? total - SHOWN_RIDES : 0;
+    printf("\n-- Ride History (%ld shown of %ld) --\n", total - skip, total);
     printf("RideID  RiderID  DriverID  Distance(km)  Fare\n");
-    for (int i = 0; i < rideCount; i++) {
+    for (int k = 0; k < v.blockCount; k++) {
+        const HistoryBlock *b = &v.blocks[k];
+        if (skip >= b->rows) { skip -= b->rows; continue; }
+        for (uint32_t i = (uint32_t)skip; i < b->rows; i++)
+            printf("%-7d %-8d %-9d %12.2f   ₹%.2f\n",
+                   b->rideId[i], b->riderId[i], b->driverId[i], b->distance[i], b->fare[i]);
+        skip = 0;
+    }
+    for (int i = (int)skip; i < rideCount; i++) {   // only when persistence is off
         printf("%-7d %-8d %-9d %12.2f   ₹%.2f\n",
                rides[i].rideId, rides[i].riderId, rides[i].driverId,
                rides[i].distance, rides[i].fare);
     }
+    history_unmap(&v);
 }
 
 void action_toggle_driver_status() {
@@ -326,17 +1026,782 @@ void action_toggle_driver_status() {
     printf("Driver not found.\n");
 }
 
+// CSV is export-only; the binary history file is the source of truth.
 void action_save_history_csv() {
+    HistoryView v;
+    history_flush();
+    if (!history_map(&v)) { printf("Failed to read %s.\n", historyPath); return; }
     FILE *fp = fopen("rides.csv", "w");
-    if (!fp) { printf("Failed to open rides.csv for writing.\n"); return; }
-    fprintf(fp, "ride_id,rider_id,driver_id,distance_km,fare\n");
+    if (!fp) { printf("Failed to open rides.csv for writing.\n"); history_unmap(&v); return; }
+    fprintf(fp, "ride_id,rider_id,driver_id,distance_km,fare,timestamp\n");
+    for (int k = 0; k < v.blockCount; k++) {
+        const HistoryBlock *b = &v.blocks[k];
+        for (uint32_t i = 0; i < b->rows; i++)
+            fprintf(fp, "%d,%d,%d,%.2f,%.2f,%lld\n", b->rideId[i], b->riderId[i],
+                    b->driverId[i], b->distance[i], b->fare[i], (long long)b->time[i]);
+    }
     for (int i = 0; i < rideCount; i++) {
-        fprintf(fp, "%d,%d,%d,%.2f,%.2f\n",
+        fprintf(fp, "%d,%d,%d,%.2f,%.2f,%lld\n",
                 rides[i].rideId, rides[i].riderId, rides[i].driverId,
-                rides[i].distance, rides[i].fare);
+                rides[i].distance, rides[i].fare, rides[i].time);
     }
     fclose(fp);
-    printf("Saved %d rides to rides.csv\n", rideCount);
+    printf("Exported %ld rides to rides.csv\n", v.rows + rideCount);
+    history_unmap(&v);
+}
+
+void action_history_analytics() {
+    int report;
+    long long windowMin = 60;
+    printf("Report (1 = revenue per driver, 2 = distance distribution, 3 = fare by time window, 0 = all): ");
+    if (scanf("%d", &report) != 1) return;
+    if (report < 0 || report > 3) { printf("Invalid report.\n"); return; }
+    if (report == 0 || report == 3) {
+        printf("Window length (minutes): ");
+        if (scanf("%lld", &windowMin) != 1 || windowMin <= 0) return;
+    }
+    run_history_analytics(report, windowMin * 60);
+}
+
+/* -----------------------------
+   Lock-free rider ingest (bounded MPMC ring)
+   Every cell carries a sequence number. A producer claims a slot by
+   CAS on enqPos and publishes it by bumping the cell's seq; consumers
+   do the mirror image on deqPos. No locks on either side.
+--------------------------------*/
+#define INGEST_CAPACITY 4096   // must be a power of two
+
+typedef struct {
+    atomic_size_t seq;
+    Rider rider;
+} IngestCell;
+
+typedef struct {
+    IngestCell cells[INGEST_CAPACITY];
+    _Alignas(CACHE_LINE) atomic_size_t enqPos;
+    _Alignas(CACHE_LINE) atomic_size_t deqPos;
+} IngestQueue;
+
+void iq_init(IngestQueue *q) {
+    for (size_t i = 0; i < INGEST_CAPACITY; i++)
+        atomic_init(&q->cells[i].seq, i);
+    atomic_init(&q->enqPos, 0);
+    atomic_init(&q->deqPos, 0);
+}
+
+int iq_enqueue(IngestQueue *q, const Rider *r) {
+    size_t pos = atomic_load_explicit(&q->enqPos, memory_order_relaxed);
+    while (1) {
+        IngestCell *c = &q->cells[pos & (INGEST_CAPACITY - 1)];
+        size_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->enqPos, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                c->rider = *r;
+                atomic_store_explicit(&c->seq, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; // full
+        } else {
+            pos = atomic_load_explicit(&q->enqPos, memory_order_relaxed);
+        }
+    }
+}
+
+int iq_dequeue(IngestQueue *q, Rider *out) {
+    size_t pos = atomic_load_explicit(&q->deqPos, memory_order_relaxed);
+    while (1) {
+        IngestCell *c = &q->cells[pos & (INGEST_CAPACITY - 1)];
+        size_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->deqPos, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                *out = c->rider;
+                atomic_store_explicit(&c->seq, pos + INGEST_CAPACITY, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; // empty
+        } else {
+            pos = atomic_load_explicit(&q->deqPos, memory_order_relaxed);
+        }
+    }
+}
+
+/* -----------------------------
+   Regional partitions
+   The map is cut into vertical stripes by x. Each stripe holds a
+   bitmap of the drivers currently standing in it plus an ingest queue
+   for riders picked up there. A driver moves to the stripe of its
+   drop-off point when its trip ends. Matching never trusts membership
+   alone: a driver is only assigned by winning the CAS available 1 -> 0,
+   so a worker borrowing a driver from a neighbour stripe can't
+   double-assign. Live positions sit in driverPos so scans never race
+   a move.
+--------------------------------*/
+#define MAX_REGIONS      16
+#define MAX_PRODUCERS    64
+#define RIDE_BATCH       64
+#define STRESS_NS_PER_KM 10000  // trip clock: 10 us of wall time per km driven
+
+#define DRIVER_WORDS ((MAX_DRIVERS + 63) / 64)
+
+typedef struct {
+    atomic_ullong members[DRIVER_WORDS];  // bit i set: drivers[i] is here
+    IngestQueue queue;
+} Region;
+
+Region regions[MAX_REGIONS];
+int regionCount = 0;
+float regionMinX = 0.0f, regionWidth = 1.0f;
+
+atomic_int ingestClosed;
+atomic_int driverOccupancy[MAX_DRIVERS]; // sanity check: must never exceed 1
+atomic_long doubleAssignments;
+atomic_ullong driverPos[MAX_DRIVERS];    // (x, y) packed as two floats
+int driverRegion[MAX_DRIVERS];           // only touched by the driver's current claimer
+
+uint64_t pack_pos(float x, float y) {
+    uint32_t a, b;
+    memcpy(&a, &x, sizeof a);
+    memcpy(&b, &y, sizeof b);
+    return (uint64_t)a << 32 | b;
+}
+
+void unpack_pos(uint64_t p, float *x, float *y) {
+    uint32_t a = (uint32_t)(p >> 32), b = (uint32_t)p;
+    memcpy(x, &a, sizeof a);
+    memcpy(y, &b, sizeof b);
+}
+
+int region_of(float x) {
+    int g = (int)((x - regionMinX) / regionWidth);
+    if (g < 0) g = 0;
+    if (g >= regionCount) g = regionCount - 1;
+    return g;
+}
+
+void partition_drivers(int nRegions) {
+    float minX = drivers[0].x, maxX = drivers[0].x;
+    for (int i = 1; i < driverCount; i++) {
+        if (drivers[i].x < minX) minX = drivers[i].x;
+        if (drivers[i].x > maxX) maxX = drivers[i].x;
+    }
+    regionCount = nRegions;
+    regionMinX = minX;
+    regionWidth = (maxX > minX) ? (maxX - minX) / nRegions : 1.0f;
+    for (int g = 0; g < regionCount; g++) {
+        for (int k = 0; k < DRIVER_WORDS; k++) atomic_store(&regions[g].members[k], 0);
+        iq_init(&regions[g].queue);
+    }
+    for (int i = 0; i < driverCount; i++) {
+        int g = region_of(drivers[i].x);
+        atomic_fetch_or(&regions[g].members[i / 64], 1ull << (i % 64));
+        driverRegion[i] = g;
+        atomic_store(&driverOccupancy[i], 0);
+        atomic_store(&driverPos[i], pack_pos(drivers[i].x, drivers[i].y));
+    }
+}
+
+// Caller holds the driver (claimed). Set the new bit before clearing the
+// old one so scanners never lose it; a double listing is harmless.
+void move_driver_region(int di, int to) {
+    int from = driverRegion[di];
+    if (from == to) return;
+    uint64_t bit = 1ull << (di % 64);
+    atomic_fetch_or_explicit(&regions[to].members[di / 64], bit, memory_order_relaxed);
+    atomic_fetch_and_explicit(&regions[from].members[di / 64], ~bit, memory_order_relaxed);
+    driverRegion[di] = to;
+}
+
+int region_driver_count(int region) {
+    int n = 0;
+    for (int k = 0; k < DRIVER_WORDS; k++)
+        n += __builtin_popcountll(atomic_load(&regions[region].members[k]));
+    return n;
+}
+
+// Push the currently available drivers of one region (no pq_init).
+void pq_add_region(const Rider *r, int region, DriverPQ *pq) {
+    Region *rg = &regions[region];
+    for (int k = 0; k < DRIVER_WORDS; k++) {
+        uint64_t m = atomic_load_explicit(&rg->members[k], memory_order_relaxed);
+        for (; m; m &= m - 1) {
+            int i = k * 64 + __builtin_ctzll(m);
+            if (!atomic_load_explicit(&drivers[i].available, memory_order_relaxed)) continue;
+            float x, y;
+            unpack_pos(atomic_load_explicit(&driverPos[i], memory_order_relaxed), &x, &y);
+            DriverPQItem it;
+            it.driverIndex = i;
+            it.distance = dist(r->x, r->y, x, y);
+            it.rating = drivers[i].rating;
+            pq_push(pq, it);
+        }
+    }
+}
+
+int try_claim_driver(int di) {
+    int expected = 1;
+    return atomic_compare_exchange_strong_explicit(&drivers[di].available, &expected, 0,
+                                                   memory_order_acquire, memory_order_relaxed);
+}
+
+void release_driver(int di) {
+    atomic_store_explicit(&drivers[di].available, 1, memory_order_release);
+}
+
+// Pop candidates best-first until one is claimed. Losing a CAS just
+// means another worker got there first; move on to the next best.
+int claim_best(DriverPQ *pq, DriverPQItem *out, long *conflicts) {
+    while (!pq_empty(pq)) {
+        DriverPQItem it = pq_pop(pq);
+        if (try_claim_driver(it.driverIndex)) { *out = it; return 1; }
+        (*conflicts)++;
+    }
+    return 0;
+}
+
+void flush_ride_batch(Ride *batch, int n) {
+    pthread_mutex_lock(&historyLock);
+    for (int i = 0; i < n; i++) history_append_locked(&batch[i]);
+    pthread_mutex_unlock(&historyLock);
+}
+
+/* -----------------------------
+   Dispatch workers and rider producers
+--------------------------------*/
+typedef struct {
+    int driverIndex;
+    uint64_t dueNs;    // drop-off time on the trip clock
+    float destX, destY;
+} ActiveTrip;
+
+typedef struct {
+    _Alignas(CACHE_LINE) int region;
+    pthread_t thread;
+    long dispatched;
+    long crossRegion;
+    long claimConflicts;
+    long idleSpins;
+    double fareTotal;
+    Ride batch[RIDE_BATCH];
+    int batchCount;
+    ActiveTrip trips[MAX_DRIVERS];  // drivers this worker has on the road
+    int tripCount;
+} DispatchWorker;
+
+typedef struct {
+    _Alignas(CACHE_LINE) pthread_t thread;
+    unsigned seed;
+    long count;
+    int firstId;
+    float minX, maxX, minY, maxY;
+    long fullSpins;
+} IngestProducer;
+
+// Drop off every trip that is due (all of them if force): move the
+// driver to the destination, then publish it as available again.
+void worker_finish_trips(DispatchWorker *w, int force) {
+    uint64_t now = now_ns();
+    for (int k = 0; k < w->tripCount; ) {
+        ActiveTrip *t = &w->trips[k];
+        if (!force && t->dueNs > now) { k++; continue; }
+        int di = t->driverIndex;
+        atomic_store_explicit(&driverPos[di], pack_pos(t->destX, t->destY), memory_order_relaxed);
+        move_driver_region(di, region_of(t->destX));
+        atomic_fetch_sub(&driverOccupancy[di], 1);
+        release_driver(di);
+        *t = w->trips[--w->tripCount];
+    }
+}
+
+void worker_dispatch(DispatchWorker *w, const Rider *r) {
+    DriverPQ pq;
+    DriverPQItem best;
+    uint64_t matchStart;
+    long conflictsBefore = w->claimConflicts;
+    int candidates, missed = 0;
+    while (1) {
+        worker_finish_trips(w, 0);
+        // Latency covers the attempt that succeeds; time spent waiting
+        // for a free driver shows up in the queue wait instead.
+        matchStart = now_ns();
+        pq_init(&pq);
+        pq_add_region(r, w->region, &pq);
+
+        // Widen to neighbouring stripes while one could hold a nearer
+        // driver than the best so far (or nothing was found yet).
+        float toLeft  = r->x - (regionMinX + w->region * regionWidth);
+        float toRight = regionMinX + (w->region + 1) * regionWidth - r->x;
+        for (int k = 1; k < regionCount; k++) {
+            int lo = w->region - k, hi = w->region + k;
+            float reach = pq_empty(&pq) ? INFINITY : pq_top(&pq).distance;
+            float edgeL = toLeft + (k - 1) * regionWidth, edgeR = toRight + (k - 1) * regionWidth;
+            int useL = lo >= 0 && edgeL < reach, useR = hi < regionCount && edgeR < reach;
+            if (!useL && !useR) break;
+            if (useL) pq_add_region(r, lo, &pq);
+            if (useR) pq_add_region(r, hi, &pq);
+        }
+        candidates = pq.size;
+        if (claim_best(&pq, &best, &w->claimConflicts)) {
+            if (driverRegion[best.driverIndex] != w->region) {
+                w->crossRegion++;
+                counter_add(&mCrossRegion, 1);
+            }
+            break;
+        }
+
+        // Whole fleet is busy; wait for someone to release a driver.
+        if (!missed) { counter_add(&mNoDriver, 1); missed = 1; }
+        w->idleSpins++;
+        sched_yield();
+    }
+    if (w->claimConflicts != conflictsBefore)
+        counter_add(&mConflicts, (uint64_t)(w->claimConflicts - conflictsBefore));
+
+    int di = best.driverIndex;
+    if (atomic_fetch_add(&driverOccupancy[di], 1) != 0)
+        atomic_fetch_add(&doubleAssignments, 1);
+
+    float tripKm = dist(r->x, r->y, r->destX, r->destY);
+    float fare = estimate_fare(tripKm);
+    uint64_t matchEnd = now_ns();
+    metrics_record_match(matchStart, matchEnd, candidates, best.distance);
+    metrics_record_fare(fare);
+    metrics_record_queue_wait(r->requestTime, matchEnd);
+    w->batch[w->batchCount++] = (Ride){ .rideId = nextRideId++, .riderId = r->id,
+                                        .driverId = drivers[di].id,
+                                        .distance = tripKm, .fare = fare,
+                                        .time = (long long)time(NULL) };
+    if (w->batchCount == RIDE_BATCH) {
+        flush_ride_batch(w->batch, w->batchCount);
+        w->batchCount = 0;
+    }
+    w->dispatched++;
+    w->fareTotal += fare;
+
+    // The driver stays claimed for the drive to the pickup plus the trip.
+    w->trips[w->tripCount++] = (ActiveTrip){
+        .driverIndex = di,
+        .dueNs = matchEnd + (uint64_t)((best.distance + tripKm) * STRESS_NS_PER_KM),
+        .destX = r->destX, .destY = r->destY };
+}
+
+void *dispatch_worker_main(void *arg) {
+    DispatchWorker *w = arg;
+    IngestQueue *q = &regions[w->region].queue;
+    Rider r;
+    while (1) {
+        // Read the flag before polling: closed + empty means done for good.
+        int closed = atomic_load_explicit(&ingestClosed, memory_order_acquire);
+        if (iq_dequeue(q, &r)) { worker_dispatch(w, &r); continue; }
+        if (closed) break;
+        worker_finish_trips(w, 0);
+        sched_yield();
+    }
+    worker_finish_trips(w, 1);
+    if (w->batchCount) flush_ride_batch(w->batch, w->batchCount);
+    w->batchCount = 0;
+    return NULL;
+}
+
+void *ingest_producer_main(void *arg) {
+    IngestProducer *p = arg;
+    Rider r;
+    strcpy(r.name, "stress");
+    for (long k = 0; k < p->count; k++) {
+        r.id = p->firstId + (int)k;
+        r.x = p->minX + (p->maxX - p->minX) * ((float)rand_r(&p->seed) / RAND_MAX);
+        r.y = p->minY + (p->maxY - p->minY) * ((float)rand_r(&p->seed) / RAND_MAX);
+        r.destX = p->minX + (p->maxX - p->minX) * ((float)rand_r(&p->seed) / RAND_MAX);
+        r.destY = p->minY + (p->maxY - p->minY) * ((float)rand_r(&p->seed) / RAND_MAX);
+        r.requestTime = now_seconds();
+        counter_add(&mRequests, 1);
+        IngestQueue *q = &regions[region_of(r.x)].queue;
+        while (!iq_enqueue(q, &r)) { p->fullSpins++; sched_yield(); }
+    }
+    return NULL;
+}
+
+void seed_random_drivers(int n, unsigned seed) {
+    for (int k = 0; k < n && driverCount < MAX_DRIVERS; k++) {
+        Driver *d = &drivers[driverCount++];
+        d->id = nextDriverId++;
+        snprintf(d->name, sizeof d->name, "auto%d", d->id);
+        d->x = 100.0f * ((float)rand_r(&seed) / RAND_MAX);
+        d->y = 100.0f * ((float)rand_r(&seed) / RAND_MAX);
+        d->rating = 3.0f + 2.0f * ((float)rand_r(&seed) / RAND_MAX);
+        atomic_store(&d->available, 1);
+    }
+}
+
+/* -----------------------------
+   Concurrent run: N producers feed regional queues, one worker per
+   region matches in parallel. Drivers stay busy for the length of
+   their trip, so the fleet saturates and workers must fight over the
+   few free drivers. Returns 1 if every request was served and no
+   driver was ever held by two workers at once; how often the contended
+   paths ran (cross-region borrowing, lost claims) is only reported,
+   since it depends on scheduling.
+--------------------------------*/
+int run_concurrent_dispatch(long requests, int nProducers, int nWorkers) {
+    if (nWorkers < 1) nWorkers = 1;
+    if (nWorkers > MAX_REGIONS) nWorkers = MAX_REGIONS;
+    if (nProducers < 1) nProducers = 1;
+    if (nProducers > MAX_PRODUCERS) nProducers = MAX_PRODUCERS;
+    if (requests < 1) requests = 1;
+
+    if (driverCount == 0) seed_random_drivers(MAX_DRIVERS, 12345u);
+    int freeDrivers = 0;
+    for (int i = 0; i < driverCount; i++) freeDrivers += drivers[i].available;
+    if (freeDrivers == 0) { printf("No available drivers to dispatch.\n"); return 0; }
+
+    partition_drivers(nWorkers);
+    atomic_store(&ingestClosed, 0);
+    atomic_store(&doubleAssignments, 0);
+
+    float minX = drivers[0].x, maxX = drivers[0].x, minY = drivers[0].y, maxY = drivers[0].y;
+    for (int i = 1; i < driverCount; i++) {
+        if (drivers[i].x < minX) minX = drivers[i].x;
+        if (drivers[i].x > maxX) maxX = drivers[i].x;
+        if (drivers[i].y < minY) minY = drivers[i].y;
+        if (drivers[i].y > maxY) maxY = drivers[i].y;
+    }
+
+    DispatchWorker *workers = calloc(nWorkers, sizeof *workers);
+    IngestProducer *producers = calloc(nProducers, sizeof *producers);
+    if (!workers || !producers) {
+        free(workers); free(producers);
+        printf("Out of memory.\n");
+        return 0;
+    }
+
+    SyntheticHistory sh = history_begin_synthetic();
+    double t0 = now_seconds();
+    for (int w = 0; w < nWorkers; w++) {
+        workers[w].region = w;
+        int err = pthread_create(&workers[w].thread, NULL, dispatch_worker_main, &workers[w]);
+        if (err != 0) {
+            // Nothing is queued yet: stop the workers that did start.
+            printf("Failed to start dispatch worker %d: %s\n", w, strerror(err));
+            atomic_store_explicit(&ingestClosed, 1, memory_order_release);
+            for (int k = 0; k < w; k++) pthread_join(workers[k].thread, NULL);
+            history_end_synthetic(sh);
+            free(workers); free(producers);
+            return 0;
+        }
+    }
+    long share = requests / nProducers, extra = requests % nProducers;
+    int firstId = nextRiderId;
+    int startedProducers = 0;
+    for (int p = 0; p < nProducers; p++) {
+        IngestProducer *pr = &producers[p];
+        pr->seed = 977u * (p + 1);
+        pr->count = share + (p < extra ? 1 : 0);
+        pr->firstId = firstId;
+        firstId += (int)pr->count;
+        pr->minX = minX; pr->maxX = maxX; pr->minY = minY; pr->maxY = maxY;
+        int err = pthread_create(&pr->thread, NULL, ingest_producer_main, pr);
+        if (err != 0) {
+            printf("Failed to start producer %d: %s\n", p, strerror(err));
+            break;
+        }
+        startedProducers++;
+    }
+    nextRiderId = firstId;
+
+    // Every worker is running, so whatever the started producers queue
+    // still drains before the workers see the queues closed.
+    long fullSpins = 0;
+    for (int p = 0; p < startedProducers; p++) {
+        pthread_join(producers[p].thread, NULL);
+        fullSpins += producers[p].fullSpins;
+    }
+    atomic_store_explicit(&ingestClosed, 1, memory_order_release);
+
+    long dispatched = 0, cross = 0, conflicts = 0, idle = 0;
+    double fares = 0.0;
+    for (int w = 0; w < nWorkers; w++) {
+        pthread_join(workers[w].thread, NULL);
+        dispatched += workers[w].dispatched;
+        cross += workers[w].crossRegion;
+        conflicts += workers[w].claimConflicts;
+        idle += workers[w].idleSpins;
+        fares += workers[w].fareTotal;
+    }
+    double elapsed = now_seconds() - t0;
+    long doubles = atomic_load(&doubleAssignments);
+    for (int i = 0; i < driverCount; i++)
+        unpack_pos(atomic_load(&driverPos[i]), &drivers[i].x, &drivers[i].y);
+    history_end_synthetic(sh);
+
+    printf("\n-- Concurrent Dispatch --\n");
+    printf("Producers: %d  Workers/regions: %d  Drivers: %d\n", nProducers, nWorkers, driverCount);
+    for (int w = 0; w < nWorkers; w++)
+        printf("Region %-2d drivers %-4d dispatched %-9ld cross-region %ld\n",
+               w, region_driver_count(w), workers[w].dispatched, workers[w].crossRegion);
+    printf("Requests: %ld  Dispatched: %ld  Cross-region: %ld\n", requests, dispatched, cross);
+    printf("Claim conflicts: %ld  Fleet-busy waits: %ld  Queue-full waits: %ld\n",
+           conflicts, idle, fullSpins);
+    printf("Total fare: ₹%.2f\n", fares);
+    printf("Elapsed: %.3f s  Throughput: %.0f dispatches/s\n",
+           elapsed, elapsed > 0 ? dispatched / elapsed : 0.0);
+    printf("Double assignments: %ld\n", doubles);
+
+    free(workers);
+    free(producers);
+
+    if (startedProducers < nProducers) {
+        printf("FAIL: aborted, only %d of %d producers started\n", startedProducers, nProducers);
+        return 0;
+    }
+    int ok = (dispatched == requests && doubles == 0);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+void action_concurrent_dispatch() {
+    long requests; int producers, workers;
+    printf("Number of requests: ");
+    if (scanf("%ld", &requests) != 1) return;
+    printf("Producer threads (max %d): ", MAX_PRODUCERS);
+    if (scanf("%d", &producers) != 1) return;
+    printf("Dispatch workers (regions, max %d): ", MAX_REGIONS);
+    if (scanf("%d", &workers) != 1) return;
+    (void)run_concurrent_dispatch(requests, producers, workers);
+}
+
+/* -----------------------------
+   Discrete-event simulation
+   Time only moves by jumping to the next scheduled event. Events live
+   in a min-heap keyed by (time, seq); at most one pickup/drop-off per
+   driver plus the next arrival are pending, so the heap stays tiny
+   even for millions of trips.
+--------------------------------*/
+#define SIM_MAP_SIZE    100.0f  // seeded fleet and riders live in [0, 100) km
+#define SIM_TRIP_RADIUS 10.0f   // drop-off within this many km of pickup
+
+typedef enum { EV_REQUEST, EV_PICKUP, EV_DROPOFF } SimEventType;
+
+typedef struct {
+    double time;
+    long seq;          // FIFO tie-break for simultaneous events
+    int type;
+    int driverIndex;   // pickup / drop-off only
+} SimEvent;
+
+typedef struct {
+    SimEvent heap[MAX_DRIVERS + 2];
+    int size;
+    long nextSeq;
+} EventQueue;
+
+int ev_before(SimEvent a, SimEvent b) {
+    if (a.time < b.time) return 1;
+    if (a.time > b.time) return 0;
+    return a.seq < b.seq;
+}
+
+void ev_init(EventQueue *eq) { eq->size = 0; eq->nextSeq = 0; }
+
+void ev_push(EventQueue *eq, double time, int type, int driverIndex) {
+    SimEvent e = { .time = time, .seq = eq->nextSeq++, .type = type, .driverIndex = driverIndex };
+    int i = ++eq->size;
+    eq->heap[i] = e;
+    while (i > 1 && ev_before(eq->heap[i], eq->heap[i / 2])) {
+        SimEvent tmp = eq->heap[i]; eq->heap[i] = eq->heap[i / 2]; eq->heap[i / 2] = tmp;
+        i /= 2;
+    }
+}
+
+SimEvent ev_pop(EventQueue *eq) {
+    SimEvent ret = eq->heap[1];
+    eq->heap[1] = eq->heap[eq->size--];
+    int i = 1;
+    while (1) {
+        int l = 2*i, r = 2*i + 1, best = i;
+        if (l <= eq->size && ev_before(eq->heap[l], eq->heap[best])) best = l;
+        if (r <= eq->size && ev_before(eq->heap[r], eq->heap[best])) best = r;
+        if (best == i) break;
+        SimEvent tmp = eq->heap[i]; eq->heap[i] = eq->heap[best]; eq->heap[best] = tmp;
+        i = best;
+    }
+    return ret;
+}
+
+typedef struct {
+    EventQueue events;
+    RiderQueue waiting;
+    Rider onTrip[MAX_DRIVERS];   // rider each busy driver is serving
+    double speedKmh;
+    double ratePerSec;
+    unsigned seed;
+    long long epoch;             // wall clock at sim time 0, for history
+    long requested, rejected, completed;
+    double waitSum;
+    HistShard waitHist;          // wait to pickup, ms of sim time
+    double tripKm, fareTotal;
+} Simulation;
+
+// Uniform in [0, 1). Divide in double: in float RAND_MAX / (RAND_MAX + 1)
+// rounds to 1.0f, which would make the exponential gap below infinite.
+double sim_uniform(Simulation *s) { return rand_r(&s->seed) / (RAND_MAX + 1.0); }
+
+double travel_seconds(const Simulation *s, float km) { return km / s->speedKmh * 3600.0; }
+
+// FIFO: keep matching the front rider to its nearest free driver.
+void sim_dispatch_waiting(Simulation *s, double now) {
+    Rider r;
+    DriverPQ pq;
+    while (rq_front(&s->waiting, &r)) {
+        uint64_t matchStart = now_ns();
+        build_driver_pq_for_rider(&r, &pq);
+        int candidates = pq.size;
+        if (pq_empty(&pq)) return;
+        DriverPQItem best = pq_pop(&pq);
+        int di = best.driverIndex;
+        metrics_record_match(matchStart, now_ns(), candidates, best.distance);
+        rq_dequeue(&s->waiting, &r);
+        drivers[di].available = 0;
+        s->onTrip[di] = r;
+        ev_push(&s->events, now + travel_seconds(s, best.distance), EV_PICKUP, di);
+    }
+}
+
+void sim_on_request(Simulation *s, double now, long totalTrips) {
+    Rider r;
+    r.id = nextRiderId++;
+    strcpy(r.name, "sim");
+    r.x = (float)(SIM_MAP_SIZE * sim_uniform(s));
+    r.y = (float)(SIM_MAP_SIZE * sim_uniform(s));
+    r.destX = fminf(fmaxf(r.x + SIM_TRIP_RADIUS * (float)(2.0 * sim_uniform(s) - 1.0), 0.0f), SIM_MAP_SIZE);
+    r.destY = fminf(fmaxf(r.y + SIM_TRIP_RADIUS * (float)(2.0 * sim_uniform(s) - 1.0), 0.0f), SIM_MAP_SIZE);
+    r.requestTime = now;
+    s->requested++;
+    counter_add(&mRequests, 1);
+    if (!rq_enqueue(&s->waiting, r)) { s->rejected++; counter_add(&mRejected, 1); }
+    else {
+        sim_dispatch_waiting(s, now);
+        // FIFO: if anyone is still waiting, the newcomer is among them.
+        // Count each rider once, on arrival, like the live paths do.
+        if (!rq_empty(&s->waiting)) counter_add(&mNoDriver, 1);
+    }
+
+    // Poisson arrivals: exponential gaps, one pending arrival at a time.
+    if (s->requested < totalTrips) {
+        double gap = -log1p(-sim_uniform(s)) / s->ratePerSec;
+        ev_push(&s->events, now + gap, EV_REQUEST, -1);
+    }
+}
+
+void sim_on_pickup(Simulation *s, double now, int di) {
+    Rider *r = &s->onTrip[di];
+    double wait = now - r->requestTime;
+    s->waitSum += wait;
+    shard_record(&s->waitHist, (uint64_t)(wait * 1000.0));
+    drivers[di].x = r->x; drivers[di].y = r->y;
+    float km = dist(r->x, r->y, r->destX, r->destY);
+    ev_push(&s->events, now + travel_seconds(s, km), EV_DROPOFF, di);
+}
+
+void sim_on_dropoff(Simulation *s, double now, int di) {
+    Rider *r = &s->onTrip[di];
+    float km = dist(r->x, r->y, r->destX, r->destY);
+    float fare = estimate_fare(km);
+    metrics_record_fare(fare);
+    record_ride(r->id, drivers[di].id, km, fare, s->epoch + (long long)now);
+    s->completed++;
+    s->tripKm += km;
+    s->fareTotal += fare;
+
+    // Driver frees up where the trip ended and can take the next rider.
+    drivers[di].x = r->destX; drivers[di].y = r->destY;
+    drivers[di].available = 1;
+    sim_dispatch_waiting(s, now);
+}
+
+/* -----------------------------
+   Headless run: trips requests at ratePerMin, driving at speedKmh.
+   Uses the current fleet (seeding one if empty) and leaves drivers
+   where their last trip ended.
+--------------------------------*/
+int run_simulation(long trips, double ratePerMin, double speedKmh) {
+    if (trips < 1 || ratePerMin <= 0.0 || speedKmh <= 0.0) {
+        printf("Invalid simulation parameters.\n");
+        return 0;
+    }
+    if (driverCount == 0) seed_random_drivers(MAX_DRIVERS, 4242u);
+
+    Simulation *s = calloc(1, sizeof *s);
+    if (!s) { printf("Out of memory.\n"); return 0; }
+    SyntheticHistory sh = history_begin_synthetic();
+    ev_init(&s->events);
+    rq_init(&s->waiting);
+    s->speedKmh = speedKmh;
+    s->ratePerSec = ratePerMin / 60.0;
+    s->seed = 2024u;
+    s->epoch = (long long)time(NULL);
+
+    double t0 = now_seconds();
+    double now = 0.0;
+    long processed = 0;
+    ev_push(&s->events, 0.0, EV_REQUEST, -1);
+    while (s->events.size > 0) {
+        SimEvent e = ev_pop(&s->events);
+        now = e.time;
+        processed++;
+        switch (e.type) {
+            case EV_REQUEST: sim_on_request(s, now, trips); break;
+            case EV_PICKUP:  sim_on_pickup(s, now, e.driverIndex); break;
+            case EV_DROPOFF: sim_on_dropoff(s, now, e.driverIndex); break;
+        }
+    }
+    double wall = now_seconds() - t0;
+    double hours = now / 3600.0;
+
+    printf("\n-- Event-Driven Simulation --\n");
+    printf("Drivers: %d  Rate: %.2f req/min  Speed: %.1f km/h\n", driverCount, ratePerMin, speedKmh);
+    printf("Requested: %ld  Completed: %ld  Rejected (queue full): %ld  Stranded: %d\n",
+           s->requested, s->completed, s->rejected, s->waiting.size);
+    printf("Simulated time: %.2f h  Throughput: %.1f trips/h\n",
+           hours, hours > 0 ? s->completed / hours : 0.0);
+    HistSnapshot *wait = calloc(1, sizeof *wait);
+    if (wait) {
+        shard_accumulate(&s->waitHist, wait);
+        printf("Wait to pickup: mean %.1f s, p50 %.1f s, p90 %.1f s, p99 %.1f s, max %.1f s\n",
+               s->completed ? s->waitSum / s->completed : 0.0,
+               snapshot_quantile(wait, 0.5) / 1000.0, snapshot_quantile(wait, 0.9) / 1000.0,
+               snapshot_quantile(wait, 0.99) / 1000.0, wait->max / 1000.0);
+        free(wait);
+    }
+    printf("Trip distance: %.1f km total  Fare: ₹%.2f total\n", s->tripKm, s->fareTotal);
+    printf("Wall time: %.3f s  (%.0f events/s)\n", wall, wall > 0 ? processed / wall : 0.0);
+
+    history_end_synthetic(sh);
+    free(s);
+    return 1;
+}
+
+void action_run_simulation() {
+    long trips; double rate, speed;
+    printf("Number of trips: ");
+    if (scanf("%ld", &trips) != 1) return;
+    printf("Arrival rate (requests/min): ");
+    if (scanf("%lf", &rate) != 1) return;
+    printf("Driving speed (km/h): ");
+    if (scanf("%lf", &speed) != 1) return;
+    (void)run_simulation(trips, rate, speed);
+}
+
+void action_dump_metrics() {
+    int fmt;
+    printf("Format (1 = JSON, 2 = Prometheus): ");
+    if (scanf("%d", &fmt) != 1) return;
+    if (fmt != METRICS_JSON && fmt != METRICS_PROMETHEUS) { printf("Invalid format.\n"); return; }
+    metrics_dump(stdout, fmt);
 }
 
 /* -----------------------------
@@ -352,12 +1817,40 @@ void print_menu() {
     printf("6. Dispatch ALL\n");
     printf("7. Show Ride History\n");
     printf("8. Toggle Driver Availability\n");
-    printf("9. Save Ride History to CSV\n");
+    printf("9. Export Ride History to CSV\n");
+    printf("10. Concurrent Dispatch Stress Test\n");
+    printf("11. Run Event-Driven Simulation\n");
+    printf("12. Dump Metrics\n");
+    printf("13. Ride History Analytics\n");
     printf("0. Exit\n");
     printf("Select: ");
 }
 
-int main() {
+int main(int argc, char **argv) {
+    metrics_init_from_env();
+    history_init(HISTORY_FILE);
+
+    // Headless: ./ride --stress [requests] [producers] [workers]
+    if (argc > 1 && strcmp(argv[1], "--stress") == 0) {
+        long requests = argc > 2 ? atol(argv[2]) : 1000000;
+        int producers = argc > 3 ? atoi(argv[3]) : 4;
+        int workers   = argc > 4 ? atoi(argv[4]) : 4;
+        return run_concurrent_dispatch(requests, producers, workers) ? 0 : 1;
+    }
+    // Headless: ./ride --sim [trips] [requests_per_min] [speed_kmh]
+    if (argc > 1 && strcmp(argv[1], "--sim") == 0) {
+        long trips  = argc > 2 ? atol(argv[2]) : 1000000;
+        double rate = argc > 3 ? atof(argv[3]) : 2.0;
+        double kmh  = argc > 4 ? atof(argv[4]) : 30.0;
+        return run_simulation(trips, rate, kmh) ? 0 : 1;
+    }
+    // Headless: ./ride --analyze [window_minutes]
+    if (argc > 1 && strcmp(argv[1], "--analyze") == 0) {
+        long long windowMin = argc > 2 ? atoll(argv[2]) : 60;
+        run_history_analytics(0, (windowMin > 0 ? windowMin : 60) * 60);
+        return 0;
+    }
+
     rq_init(&riderQueue);
     int choice;
     while (1) {
@@ -373,6 +1866,10 @@ int main() {
             case 7: action_show_ride_history(); break;
             case 8: action_toggle_driver_status(); break;
             case 9: action_save_history_csv(); break;
+            case 10: action_concurrent_dispatch(); break;
+            case 11: action_run_simulation(); break;
+            case 12: action_dump_metrics(); break;
+            case 13: action_history_analytics(); break;
             case 0: printf("Bye!\n"); return 0;
             default: printf("Invalid option.\n"); break;
         }